@@ -1,6 +1,9 @@
 #include "synchronized_value.h"
 
 #include <print>
+#include <map>
+#include <latch>
+#include <thread>
 
 struct cat {
     std::string name;
@@ -74,6 +77,40 @@ int main() {
     liza->say_it();
     mourek->say_it();
 
+    {
+        //get_or_compute on map values - concurrent misses of the same key compute it only once
+        synchronized_value<std::map<std::string, int>> lives_by_name{std::map<std::string, int>{}};
+        int computed = lives_by_name.get_or_compute("Liza", [](const std::string &) { return 9; });
+        int cached = lives_by_name.get_or_compute("Liza", [](const std::string &) { return 0; });
+        std::print("Liza has {} lives, cached {}\n", computed, cached);
+    }
+
+    {
+        //value groups freeze all their values at once, e.g. for a consistent snapshot
+        value_group shelter;
+        value_group street;
+        synchronized_value<cat> tom{shelter, cat{"Tom"}};
+        synchronized_value<cat> jerry{shelter, cat{"Jerry"}};
+        synchronized_value<cat> felix{street, cat{"Felix"}};
+
+        //holding a value of another group does not hold the freeze up
+        auto felix_access = *felix;
+
+        //the freeze waits for values other threads hold, those threads may still nest into the group
+        std::latch holding{1};
+        std::jthread keeper([&] {
+            auto tom_access = *tom;
+            holding.count_down();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            jerry->lives_cnt = 8;
+        });
+        holding.wait();
+        {
+            auto freeze = shelter.freeze();
+            std::print("{} has {} lives when the shelter is frozen\n", jerry->name, jerry->lives_cnt);
+        }
+    }
+
     ///todo: mimic shared_mutex behavior
     return 0;
 }
\ No newline at end of file
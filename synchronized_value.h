@@ -5,6 +5,243 @@
 #include <compare>
 #include <mutex>
 #include <concepts>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <expected>
+#include <ranges>
+#include <memory>
+#include <condition_variable>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <stop_token>
+
+#if defined(SYNCHRONIZED_VALUE_INJECT_CONTENTION)
+#include <random>
+#endif
+
+// ---------------------------
+// holder run state
+// ---------------------------
+namespace detail{
+    // Per-thread "not voluntarily blocked" flag, cleared only inside blocking_scope. A lock
+    // holder publishes its slot in the lock so waiters can stop spinning once the holder
+    // blocks. It says nothing about preemption - a descheduled holder still looks
+    // unblocked, which is why waiters also bound their spinning by time. Slots are
+    // recycled on thread exit but never freed, so a waiter reading a stale slot only
+    // gets a wrong hint.
+    struct thread_state
+    {
+        std::atomic<bool> not_blocked{true};
+        thread_state *next_free = nullptr;
+
+        static thread_state &current()
+        {
+            struct slot_owner
+            {
+                thread_state *state = acquire_slot();
+                ~slot_owner() { release_slot(state); }
+            };
+            thread_local slot_owner owner;
+            return *owner.state;
+        }
+
+    private:
+        static inline std::mutex free_mutex;
+        static inline thread_state *free_list = nullptr;
+
+        static thread_state *acquire_slot()
+        {
+            std::lock_guard guard(free_mutex);
+            if (!free_list)
+                return new thread_state;
+
+            auto *state = std::exchange(free_list, free_list->next_free);
+            state->not_blocked.store(true, std::memory_order_relaxed);
+            return state;
+        }
+
+        static void release_slot(thread_state *state)
+        {
+            std::lock_guard guard(free_mutex);
+            state->next_free = std::exchange(free_list, state);
+        }
+    };
+
+    inline void cpu_relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+}
+
+// Marks the calling thread as blocked (I/O, sleeping, waiting) for its lifetime, so threads
+// waiting for locks it holds park right away instead of spinning.
+class blocking_scope
+{
+    detail::thread_state &state = detail::thread_state::current();
+    bool was_not_blocked = state.not_blocked.exchange(false, std::memory_order_relaxed);
+
+public:
+    blocking_scope() = default;
+    blocking_scope(const blocking_scope &) = delete;
+    blocking_scope &operator=(const blocking_scope &) = delete;
+
+    ~blocking_scope()
+    {
+        state.not_blocked.store(was_not_blocked, std::memory_order_relaxed);
+    }
+};
+
+// ---------------------------
+// contention injection
+// ---------------------------
+// Build with SYNCHRONIZED_VALUE_INJECT_CONTENTION defined to make lock acquisition
+// and critical sections pass through random yields and delays. The random stream
+// is seeded, so a given seed and thread layout replays the same schedule pressure.
+// Without the define the hooks are empty and compile away. The hooks live in
+// detail::lockable and in k-exclusion slot claims only, so every acquisition rolls each
+// point exactly once.
+struct contention_injection_point_config
+{
+    double yield_probability = 0.0;          // chance of std::this_thread::yield (sched_yield)
+    double delay_probability = 0.0;          // chance of sleeping
+};
+
+struct contention_injection_config
+{
+    std::uint64_t seed = 0;
+    contention_injection_point_config before_acquire;   // about to contend for the lock
+    contention_injection_point_config after_acquire;    // lock just taken - delay here stretches the critical section
+    contention_injection_point_config before_release;   // still inside the critical section
+    std::chrono::microseconds max_delay{0};             // sleep length is uniform in [0, max_delay]
+};
+
+// ---------------------------
+// admission control
+// ---------------------------
+// Limits for synchronized_value::try_access. Zero disables the respective limit. Held ranges
+// of a range_synchronized_value and busy slots of a k_synchronized_value count as queued,
+// whole-value access has to wait for them.
+struct admission_policy
+{
+    std::uint32_t max_waiters = 0;                  // shed when this many threads already queue for the lock
+    std::chrono::nanoseconds max_expected_wait{0};  // shed when queue length times recent average hold time exceeds this
+};
+
+enum class admission_rejected
+{
+    too_many_waiters,
+    expected_wait_too_long,
+};
+
+namespace detail{
+    enum class injection_point
+    {
+        before_acquire,
+        after_acquire,
+        before_release,
+    };
+
+#if defined(SYNCHRONIZED_VALUE_INJECT_CONTENTION)
+    struct contention_injector
+    {
+        static inline std::mutex config_mutex;
+        static inline contention_injection_config config;
+        static inline std::atomic<std::uint64_t> config_generation{0};
+        static inline std::atomic<std::uint64_t> next_stream{0};
+
+        struct thread_state
+        {
+            std::uint64_t generation = ~std::uint64_t{0};
+            std::uint64_t stream = next_stream.fetch_add(1, std::memory_order_relaxed);
+            contention_injection_config config;
+            std::mt19937_64 rng;
+        };
+
+        static thread_state &local()
+        {
+            thread_local thread_state state;
+            return state;
+        }
+
+        static void refresh(thread_state &state)
+        {
+            const auto generation = config_generation.load(std::memory_order_acquire);
+            if (state.generation == generation)
+                return;
+
+            std::lock_guard guard(config_mutex);
+            state.config = config;
+            state.generation = config_generation.load(std::memory_order_relaxed);
+            state.rng.seed(state.config.seed ^ (0x9e3779b97f4a7c15ull * (state.stream + 1)));
+        }
+
+        static const contention_injection_point_config &settings(const contention_injection_config &config, injection_point point)
+        {
+            switch (point)
+            {
+            case injection_point::before_acquire: return config.before_acquire;
+            case injection_point::after_acquire: return config.after_acquire;
+            case injection_point::before_release: break;
+            }
+            return config.before_release;
+        }
+
+        static void inject(injection_point point)
+        {
+            auto &state = local();
+            refresh(state);
+            const auto &point_config = settings(state.config, point);
+
+            std::uniform_real_distribution<double> chance(0.0, 1.0);
+            if (chance(state.rng) < point_config.yield_probability)
+                std::this_thread::yield();
+
+            if (state.config.max_delay.count() > 0 && chance(state.rng) < point_config.delay_probability)
+            {
+                // deliberately no blocking_scope: this stands in for preemption, which waiters
+                // cannot see either, so they keep spinning against a holder that looks runnable
+                std::uniform_int_distribution<std::int64_t> delay(0, state.config.max_delay.count());
+                std::this_thread::sleep_for(std::chrono::microseconds{delay(state.rng)});
+            }
+        }
+    };
+
+    inline void inject_contention(injection_point point) { contention_injector::inject(point); }
+#else
+    inline void inject_contention(injection_point) {}
+#endif
+}
+
+// Replaces the injection settings for all threads; each thread reseeds its stream on its next injection point.
+inline void configure_contention_injection([[maybe_unused]] const contention_injection_config &config)
+{
+#if defined(SYNCHRONIZED_VALUE_INJECT_CONTENTION)
+    std::lock_guard guard(detail::contention_injector::config_mutex);
+    detail::contention_injector::config = config;
+    detail::contention_injector::config_generation.fetch_add(1, std::memory_order_release);
+#endif
+}
+
+// Pins the calling thread to a fixed random stream; streams are otherwise handed out in first-use order.
+inline void set_contention_injection_stream([[maybe_unused]] std::uint64_t stream)
+{
+#if defined(SYNCHRONIZED_VALUE_INJECT_CONTENTION)
+    auto &state = detail::contention_injector::local();
+    state.stream = stream;
+    state.generation = ~std::uint64_t{0};
+#endif
+}
 
 // ---------------------------
 // synchronized_value
@@ -16,149 +253,1465 @@ template <SynchronizedValue... SVs>
 class synchronized_scope;
 
 namespace detail{
+    struct lockable;
+}
+
+template <typename T, typename Lockable = detail::lockable>
+class synchronized_value;
+
+// ---------------------------
+// value_group
+// ---------------------------
+namespace detail{
+    inline constexpr std::size_t cache_line_size = 64;
+
+    // stable per-thread value for picking a home stripe/slot
+    inline std::size_t thread_affinity()
+    {
+        thread_local const std::size_t affinity = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        return affinity;
+    }
+}
+
+// Values constructed with a group can all be frozen at once. freeze() blocks new accesses,
+// waits until every admitted access has been released and then lets the freezing thread
+// access every value of the group until the guard is gone. A thread that already holds a
+// value of the group is still admitted while the freeze drains, so its nested accesses
+// finish instead of deadlocking against it. Admitted accesses are counted in striped
+// counters, so accesses from different threads do not contend on one cache line.
+class value_group
+{
+public:
+    class freeze_guard
+    {
+        value_group &group;
+
+    public:
+        explicit freeze_guard(value_group &g)
+            : group(g)
+        {
+            group.freeze_mutex.lock();
+            group.freezer.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+            // seq_cst store and stripe loads pair with enter(): an access that missed the flag
+            // is already counted here, one that saw it is turned away unless it nests
+            group.frozen.store(true, std::memory_order_seq_cst);
+
+            // accesses the freezing thread holds itself cannot drain
+            const std::uint64_t own_holds = group.holds_by_current_thread();
+            for (;;)
+            {
+                const auto releases = group.releases.load(std::memory_order_seq_cst);
+                if (group.admitted() == own_holds)
+                    break;
+
+                blocking_scope parked;
+                group.releases.wait(releases, std::memory_order_seq_cst);
+            }
+        }
+
+        ~freeze_guard()
+        {
+            group.freezer.store(std::thread::id{}, std::memory_order_relaxed);
+            group.frozen.store(false, std::memory_order_release);
+            group.frozen.notify_all();
+            group.freeze_mutex.unlock();
+        }
+
+        freeze_guard(const freeze_guard &) = delete;
+        freeze_guard &operator=(const freeze_guard &) = delete;
+    };
+
+    value_group() = default;
+    value_group(const value_group &) = delete;
+    value_group &operator=(const value_group &) = delete;
+
+    // Freezes the whole group for the lifetime of the returned guard.
+    [[nodiscard]] freeze_guard freeze() { return freeze_guard{*this}; }
+
+private:
+    friend struct detail::lockable;
+
+    struct alignas(detail::cache_line_size) stripe
+    {
+        std::atomic<std::uint64_t> count{0};    // admitted accesses not yet released, plus turned away ones in flight
+    };
+
+    static constexpr std::size_t stripe_count = 16;
+
+    stripe stripes[stripe_count];
+    alignas(detail::cache_line_size) std::atomic<bool> frozen{false};
+    std::atomic<std::uint32_t> releases{0};    // bumped by releases during a freeze, the freezer waits on it
+    std::atomic<std::thread::id> freezer;
+    std::mutex freeze_mutex;    // one freeze at a time
+
+    // values the current thread holds, per group; a thread holds values of few groups at once
+    using hold_table = std::vector<std::pair<const value_group *, std::uint32_t>>;
+
+    static hold_table &current_thread_holds()
+    {
+        thread_local hold_table holds;
+        return holds;
+    }
+
+    std::uint32_t holds_by_current_thread() const
+    {
+        const auto &holds = current_thread_holds();
+        const auto it = std::ranges::find(holds, this, &hold_table::value_type::first);
+        return it != holds.end() ? it->second : 0;
+    }
+
+    stripe &current_stripe() { return stripes[detail::thread_affinity() % stripe_count]; }
+
+    std::uint64_t admitted() const
+    {
+        std::uint64_t total = 0;
+        for (const auto &s : stripes)
+            total += s.count.load(std::memory_order_seq_cst);
+        return total;
+    }
+
+    // Called with the value's lock held; false means the caller must let go and wait_thawed().
+    bool enter()
+    {
+        auto &s = current_stripe();
+        s.count.fetch_add(1, std::memory_order_seq_cst);
+        if (!frozen.load(std::memory_order_seq_cst) ||
+            freezer.load(std::memory_order_relaxed) == std::this_thread::get_id() ||
+            holds_by_current_thread() != 0)
+        {
+            auto &holds = current_thread_holds();
+            if (auto it = std::ranges::find(holds, this, &hold_table::value_type::first); it != holds.end())
+                ++it->second;
+            else
+                holds.emplace_back(this, 1);
+            return true;
+        }
+
+        release_count(s);
+        return false;
+    }
+
+    void leave()
+    {
+        auto &holds = current_thread_holds();
+        auto it = std::ranges::find(holds, this, &hold_table::value_type::first);
+        if (--it->second == 0)
+        {
+            *it = holds.back();
+            holds.pop_back();
+        }
+        release_count(current_stripe());
+    }
+
+    void release_count(stripe &s)
+    {
+        // seq_cst pairs with the freezer's flag store and stripe loads, see freeze_guard
+        s.count.fetch_sub(1, std::memory_order_seq_cst);
+        if (frozen.load(std::memory_order_seq_cst))
+        {
+            releases.fetch_add(1, std::memory_order_seq_cst);
+            releases.notify_all();
+        }
+    }
+
+    void wait_thawed() const
+    {
+        blocking_scope parked;
+        frozen.wait(true, std::memory_order_acquire);
+    }
+};
+
+namespace detail{
+    // tag for lock(): the caller already counted itself in waiters, see lockable::reserve_waiter
+    struct waiter_reserved_t { explicit waiter_reserved_t() = default; };
+    inline constexpr waiter_reserved_t waiter_reserved{};
+
     struct lockable
     {
+        // waiters spin at most this long even while the holder is not blocked - preemption
+        // of the holder is not visible in its run state; shorter when hold times are known
+        static constexpr std::chrono::nanoseconds max_spin_time{4000};
+
         std::atomic<std::thread::id> locker_thread_id;
+        std::atomic<thread_state *> owner_state{nullptr};
+        std::atomic<std::uint32_t> waiters{0};
+        std::atomic<std::uint64_t> generation{0};   // bumped on every release, written by the holder only
+        value_group *group = nullptr;
+
+        // admission limits, zero means unlimited
+        std::atomic<std::uint32_t> max_waiters{0};
+        std::atomic<std::int64_t> max_expected_wait_ns{0};
+
+        // moving average of hold times, only maintained while max_expected_wait_ns is set
+        std::atomic<std::int64_t> average_hold_ns{0};
+        std::chrono::steady_clock::time_point acquired_at{};   // written by the holder only
         
         void lock()
         {
-            const auto current_thread_id = std::this_thread::get_id();
-                
-            auto expected = std::thread::id{};
-            while (!locker_thread_id.compare_exchange_weak(expected, current_thread_id, std::memory_order_acquire, std::memory_order_relaxed))
-                expected = std::thread::id{};
+            lock_counted(false);
+        }
+
+        void lock(waiter_reserved_t)
+        {
+            lock_counted(true);
         }
 
         void unlock()
         {
-            locker_thread_id.store(std::thread::id{}, std::memory_order_release);
+            inject_contention(injection_point::before_release);
+            on_release();
+            generation.store(generation.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            release();
         }
 
         bool try_lock()
         {
             const auto current_thread_id = std::this_thread::get_id();
-                
+
+            inject_contention(injection_point::before_acquire);
+
             auto expected = std::thread::id{};
-            return locker_thread_id.compare_exchange_strong(expected, current_thread_id, std::memory_order_acquire, std::memory_order_relaxed);    
+            if (!locker_thread_id.compare_exchange_strong(expected, current_thread_id, std::memory_order_acquire, std::memory_order_relaxed))
+                return false;
+
+            if (group && !group->enter())
+            {
+                release();
+                return false;
+            }
+
+            on_acquired();
+            return true;
         }
-    };
-}
-template <typename T>
-class synchronized_value
-{
-public:
-    using lockable_type = detail::lockable;
 
-    auto operator<=>(const synchronized_value &other) const
-    {
-        synchronized_scope scope(const_cast<synchronized_value &>(*this), const_cast<synchronized_value &>(other));
-        return obj <=> other.obj;
-    }
+        // Hooks for access_proxy::yield_if_contended; lock types with other kinds of waiters extend them.
+        bool has_waiters() const
+        {
+            return waiters.load(std::memory_order_relaxed) != 0;
+        }
 
-    bool operator==(const synchronized_value &other) const
-    {
-        synchronized_scope scope(const_cast<synchronized_value &>(*this), const_cast<synchronized_value &>(other));
-        return obj == other.obj;
-    }
+        // changes whenever someone else may have modified the value, +1 per own unlock
+        std::uint64_t version() const
+        {
+            return generation.load(std::memory_order_relaxed);
+        }
 
-    template <typename U>
-    synchronized_value(U &&val) : obj(std::forward<U>(val)) {}
+        // Decides whether a caller that found the lock taken may queue up or must be shed.
+        // On admission the caller is already counted in waiters and has to follow up with
+        // lock(waiter_reserved), so concurrent callers cannot overshoot max_waiters. Lock
+        // types whose lock() also drains other holders pass those as ahead.
+        std::optional<admission_rejected> reserve_waiter(std::uint32_t ahead = 0)
+        {
+            const auto waiter_limit = max_waiters.load(std::memory_order_relaxed);
+            const auto wait_limit = max_expected_wait_ns.load(std::memory_order_relaxed);
 
-    synchronized_value(const synchronized_value &) = delete;
-    synchronized_value &operator=(const synchronized_value &) = delete;
+            auto queued = waiters.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                if (waiter_limit != 0 && queued + ahead >= waiter_limit)
+                    return admission_rejected::too_many_waiters;
 
-    class access_proxy
-    {
-        synchronized_value<T>& ptr;
-        bool owns_lock = false;
-        struct no_escape_ptr
+                // everyone queued ahead plus the current holder is expected to take an average hold
+                if (wait_limit != 0 && (queued + ahead + 1) * average_hold_ns.load(std::memory_order_relaxed) > wait_limit)
+                    return admission_rejected::expected_wait_too_long;
+
+                if (waiters.compare_exchange_weak(queued, queued + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    return std::nullopt;
+            }
+        }
+
+    private:
+        void lock_counted(bool waiter_counted)
         {
-            T *obj;
-            T *operator->() const { return obj; }
+            const auto current_thread_id = std::this_thread::get_id();
 
-            // prevent implicit conversion to T*
-            operator T *() const = delete;
-        };
+            inject_contention(injection_point::before_acquire);
 
-    public:
-        access_proxy(const access_proxy &) = delete;
-        access_proxy &operator=(const access_proxy &) = delete;
-        access_proxy(access_proxy &&) = delete;
-        access_proxy &operator=(access_proxy &&) = delete;
+            for (;;)
+            {
+                auto expected = std::thread::id{};
+                if (!locker_thread_id.compare_exchange_strong(expected, current_thread_id, std::memory_order_acquire, std::memory_order_relaxed))
+                    lock_contended(current_thread_id, waiter_counted);
+                else if (waiter_counted)
+                    waiters.fetch_sub(1, std::memory_order_relaxed);
+                waiter_counted = false;
 
-        ~access_proxy()
+                if (!group || group->enter())
+                    break;
+
+                // group is frozen - step back until it thaws
+                release();
+                group->wait_thawed();
+            }
+
+            on_acquired();
+        }
+
+        void release()
         {
-            if (owns_lock)
-                ptr.lock.unlock();
+            // seq_cst store and load pair with the waiter registration in lock_contended
+            locker_thread_id.store(std::thread::id{}, std::memory_order_seq_cst);
+            if (waiters.load(std::memory_order_seq_cst) != 0)
+                locker_thread_id.notify_one();
         }
 
-        access_proxy(synchronized_value<T> &p)
-            : ptr(p)
+        // Optimistic spinning as long as the holder is running, parking otherwise.
+        void lock_contended(std::thread::id current_thread_id, bool waiter_counted)
         {
+            if (!waiter_counted)
+                waiters.fetch_add(1, std::memory_order_seq_cst);
 
-            const auto current_thread_id = std::this_thread::get_id();
-            
-            // already locked by current thread
-            if (ptr.lock.locker_thread_id.load(std::memory_order_relaxed) == current_thread_id)
-                return;
+            auto spin_deadline = std::chrono::steady_clock::now() + spin_budget();
+            for (unsigned spins = 0;; ++spins)
+            {
+                auto expected = std::thread::id{};
+                if (locker_thread_id.compare_exchange_weak(expected, current_thread_id, std::memory_order_seq_cst))
+                    break;
+                if (expected == std::thread::id{})
+                    continue;
 
-            owns_lock = true;
-            ptr.lock.lock();
+                // reading the clock every round would cost more than the pause itself
+                if (owner_not_blocked() && (spins % 16 != 0 || std::chrono::steady_clock::now() < spin_deadline))
+                {
+                    cpu_relax();
+                    continue;
+                }
+
+                {
+                    blocking_scope parked;
+                    locker_thread_id.wait(expected, std::memory_order_seq_cst);
+                }
+                spin_deadline = std::chrono::steady_clock::now() + spin_budget();
+            }
+
+            waiters.fetch_sub(1, std::memory_order_relaxed);
         }
 
-        no_escape_ptr operator->() { return no_escape_ptr{&(ptr.obj)}; }
-        T &operator*() { return ptr.obj; }
+        bool owner_not_blocked() const
+        {
+            // no slot yet means the holder is between its CAS and publishing - certainly not blocked
+            const auto *owner = owner_state.load(std::memory_order_acquire);
+            return !owner || owner->not_blocked.load(std::memory_order_relaxed);
+        }
 
-        access_proxy &operator=(const T &rhs)
+        // Spinning longer than a typical hold means the holder is most likely descheduled.
+        std::chrono::nanoseconds spin_budget() const
         {
-            ptr.obj = rhs;
-            return *this;
+            const std::chrono::nanoseconds average{average_hold_ns.load(std::memory_order_relaxed)};
+            return average.count() != 0 ? std::min(2 * average, max_spin_time) : max_spin_time;
         }
 
-        access_proxy &operator=(T &&rhs)
+        void on_acquired()
         {
-            ptr.obj = std::move(rhs);
-            return *this;
+            owner_state.store(&thread_state::current(), std::memory_order_release);
+
+            if (max_expected_wait_ns.load(std::memory_order_relaxed) != 0)
+                acquired_at = std::chrono::steady_clock::now();
+
+            inject_contention(injection_point::after_acquire);
         }
 
-        operator T() const
+        void on_release()
         {
-            return ptr.obj; 
+            owner_state.store(nullptr, std::memory_order_relaxed);
+            if (group)
+                group->leave();
+
+            if (acquired_at == std::chrono::steady_clock::time_point{})
+                return;
+
+            const std::int64_t held = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - acquired_at).count();
+            acquired_at = {};
+
+            // EWMA with 1/8 weight seeded by the first sample, only the holder writes it
+            const auto average = average_hold_ns.load(std::memory_order_relaxed);
+            average_hold_ns.store(average == 0 ? held : average + (held - average) / 8, std::memory_order_relaxed);
         }
     };
-
-    auto operator->()
+}
+namespace detail{
+    // Lock for contiguous containers that, besides the usual whole-value locking, hands out
+    // locks on index ranges. Non-overlapping ranges and overlapping shared ranges are held
+    // concurrently; whole-value access waits until all ranges are returned and holds new
+    // ones off meanwhile - except for threads that already hold a range, which may take
+    // further non-conflicting ranges at any time. A thread holding a range must not ask for
+    // a conflicting range or the whole value. Range holders are not covered by
+    // value_group::freeze.
+    struct range_lockable : lockable
     {
-        return access_proxy{*this};
-    }
+        struct range
+        {
+            std::size_t begin;
+            std::size_t end;
+            bool exclusive;
 
-    auto operator*()
-    {
-        return operator->();
-    }
-    
-    private:
-        lockable_type lock;
-        T obj;
-        
-        template <SynchronizedValue... SVs>
-        friend class synchronized_scope;
-};
+            bool conflicts_with(const range &other) const
+            {
+                return begin < other.end && other.begin < end && (exclusive || other.exclusive);
+            }
+        };
 
-// ---------------------------
+        std::mutex ranges_mutex;
+        std::condition_variable ranges_changed;
+        struct grant
+        {
+            range held;
+            std::thread::id holder;
+        };
+
+        std::vector<grant> granted;
+        bool whole_locked = false;    // whole-value holder present or draining the ranges
+
+        // read without ranges_mutex by yield_if_contended
+        std::atomic<std::uint32_t> range_waiters{0};
+        std::atomic<std::uint64_t> exclusive_range_releases{0};
+
+        bool has_waiters() const
+        {
+            return lockable::has_waiters() || range_waiters.load(std::memory_order_relaxed) != 0;
+        }
+
+        std::uint64_t version() const
+        {
+            return lockable::version() + exclusive_range_releases.load(std::memory_order_relaxed);
+        }
+
+        void lock()
+        {
+            lockable::lock();
+            exclude_ranges();
+        }
+
+        void lock(waiter_reserved_t reserved)
+        {
+            lockable::lock(reserved);
+            exclude_ranges();
+        }
+
+        void exclude_ranges()
+        {
+            std::unique_lock guard(ranges_mutex);
+            whole_locked = true;
+            if (!granted.empty())
+            {
+                blocking_scope parked;
+                ranges_changed.wait(guard, [&] { return granted.empty(); });
+            }
+        }
+
+        // range holders are drained before a whole-value locker gets in, they count as queued ahead
+        std::optional<admission_rejected> reserve_waiter()
+        {
+            std::size_t held;
+            {
+                std::lock_guard guard(ranges_mutex);
+                held = granted.size();
+            }
+            return lockable::reserve_waiter(static_cast<std::uint32_t>(held));
+        }
+
+        bool try_lock()
+        {
+            if (!lockable::try_lock())
+                return false;
+
+            {
+                std::lock_guard guard(ranges_mutex);
+                if (granted.empty())
+                {
+                    whole_locked = true;
+                    return true;
+                }
+            }
+            lockable::unlock();
+            return false;
+        }
+
+        void unlock()
+        {
+            {
+                std::lock_guard guard(ranges_mutex);
+                whole_locked = false;
+            }
+            ranges_changed.notify_all();
+            lockable::unlock();
+        }
+
+        void lock_range(const range &requested)
+        {
+            const auto current_thread_id = std::this_thread::get_id();
+
+            std::unique_lock guard(ranges_mutex);
+            const auto available = [&] {
+                // a draining whole-value locker waits for this thread's ranges anyway, holding
+                // the new one off as well would leave both waiting for each other
+                const bool admitted = !whole_locked || std::ranges::find(granted, current_thread_id, &grant::holder) != granted.end();
+                return admitted && std::ranges::none_of(granted, [&](const grant &g) { return g.held.conflicts_with(requested); });
+            };
+            if (!available())
+            {
+                blocking_scope parked;
+                range_waiters.fetch_add(1, std::memory_order_relaxed);
+                ranges_changed.wait(guard, available);
+                range_waiters.fetch_sub(1, std::memory_order_relaxed);
+            }
+            granted.push_back({requested, current_thread_id});
+        }
+
+        void unlock_range(const range &released)
+        {
+            {
+                std::lock_guard guard(ranges_mutex);
+                auto it = std::ranges::find_if(granted, [&, current_thread_id = std::this_thread::get_id()](const grant &g) {
+                    return g.held.begin == released.begin && g.held.end == released.end && g.held.exclusive == released.exclusive &&
+                           g.holder == current_thread_id;
+                });
+                granted.erase(it);
+                if (released.exclusive)
+                    exclusive_range_releases.fetch_add(1, std::memory_order_relaxed);
+            }
+            ranges_changed.notify_all();
+        }
+    };
+}
+
+namespace detail{
+    template <typename T>
+    concept MapLike = requires(T &map, const typename T::key_type &key, typename T::mapped_type &&value) {
+        map.find(key) == map.end();
+        map.try_emplace(key, std::move(value));
+    };
+
+    // keys currently being computed by get_or_compute, guarded by the value's lock
+    template <typename Map>
+    struct flight_table
+    {
+        using key_type = typename Map::key_type;
+        using flight = std::shared_future<typename Map::mapped_type>;
+
+        // in-flight keys are few, a flat list avoids needing the map's hash/compare types
+        std::vector<std::pair<key_type, flight>> entries;
+
+        static bool same_key(const Map &map, const key_type &a, const key_type &b)
+        {
+            if constexpr (requires { map.key_eq(); })
+                return map.key_eq()(a, b);
+            else
+            {
+                const auto less = map.key_comp();
+                return !less(a, b) && !less(b, a);
+            }
+        }
+
+        auto find(const Map &map, const key_type &key)
+        {
+            return std::ranges::find_if(entries, [&](const auto &entry) { return same_key(map, entry.first, key); });
+        }
+
+        void erase(const Map &map, const key_type &key)
+        {
+            if (auto it = find(map, key); it != entries.end())
+                entries.erase(it);
+        }
+    };
+
+    struct no_flight_table {};
+}
+
+template <typename T, typename Lockable>
+class synchronized_value
+{
+public:
+    using lockable_type = Lockable;
+
+    auto operator<=>(const synchronized_value &other) const
+    {
+        synchronized_scope scope(const_cast<synchronized_value &>(*this), const_cast<synchronized_value &>(other));
+        return obj <=> other.obj;
+    }
+
+    bool operator==(const synchronized_value &other) const
+    {
+        synchronized_scope scope(const_cast<synchronized_value &>(*this), const_cast<synchronized_value &>(other));
+        return obj == other.obj;
+    }
+
+    template <typename U>
+    synchronized_value(U &&val) : obj(std::forward<U>(val)) {}
+
+    // member of a group that value_group::freeze stops as a whole; the group must outlive it
+    template <typename U>
+    synchronized_value(value_group &group, U &&val) : obj(std::forward<U>(val))
+    {
+        lock.group = &group;
+    }
+
+    synchronized_value(const synchronized_value &) = delete;
+    synchronized_value &operator=(const synchronized_value &) = delete;
+
+    struct no_escape_ptr
+    {
+        T *obj;
+        T *operator->() const { return obj; }
+
+        // prevent implicit conversion to T*
+        operator T *() const = delete;
+    };
+
+    class access_proxy
+    {
+        synchronized_value& ptr;
+        bool owns_lock = false;
+
+    public:
+        access_proxy(const access_proxy &) = delete;
+        access_proxy &operator=(const access_proxy &) = delete;
+        access_proxy(access_proxy &&) = delete;
+        access_proxy &operator=(access_proxy &&) = delete;
+
+        ~access_proxy()
+        {
+            if (owns_lock)
+                ptr.lock.unlock();
+        }
+
+        // takes over a lock the caller already acquired
+        access_proxy(synchronized_value &p, std::adopt_lock_t)
+            : ptr(p), owns_lock(true)
+        {}
+
+        access_proxy(synchronized_value &p)
+            : ptr(p)
+        {
+
+            const auto current_thread_id = std::this_thread::get_id();
+            
+            // already locked by current thread
+            if (ptr.lock.locker_thread_id.load(std::memory_order_relaxed) == current_thread_id)
+                return;
+
+            owns_lock = true;
+            ptr.lock.lock();
+        }
+
+        // Lock break for long critical sections: when other threads queue for the lock it is
+        // released, a waiter gets the chance to run and the lock is taken again. Returns true
+        // when someone else held the lock in between, i.e. the value may have changed and
+        // anything derived from it must be revalidated. No-op for a proxy nested in a scope.
+        bool yield_if_contended()
+        {
+            auto &lock = ptr.lock;
+            if (!owns_lock || !lock.has_waiters())
+                return false;
+
+            const auto released_version = lock.version() + 1;
+            lock.unlock();
+
+            // unlock woke or released a waiter, give it a moment to get in before queueing again
+            for (int attempt = 0; attempt < 64; ++attempt)
+            {
+                if (lock.locker_thread_id.load(std::memory_order_relaxed) != std::thread::id{} || !lock.has_waiters())
+                    break;
+                std::this_thread::yield();
+            }
+
+            lock.lock();
+            return lock.version() != released_version;
+        }
+
+        no_escape_ptr operator->() { return no_escape_ptr{&(ptr.obj)}; }
+        T &operator*() { return ptr.obj; }
+
+        access_proxy &operator=(const T &rhs)
+        {
+            ptr.obj = rhs;
+            return *this;
+        }
+
+        access_proxy &operator=(T &&rhs)
+        {
+            ptr.obj = std::move(rhs);
+            return *this;
+        }
+
+        operator T() const
+        {
+            return ptr.obj; 
+        }
+    };
+
+    auto operator->()
+    {
+        return access_proxy{*this};
+    }
+
+    auto operator*()
+    {
+        return operator->();
+    }
+
+    void set_admission_policy(const admission_policy &policy)
+    {
+        lock.max_waiters.store(policy.max_waiters, std::memory_order_relaxed);
+        lock.max_expected_wait_ns.store(policy.max_expected_wait.count(), std::memory_order_relaxed);
+    }
+
+    // Like operator-> but fails fast instead of joining an overlong queue, see set_admission_policy.
+    std::expected<access_proxy, admission_rejected> try_access()
+    {
+        // already locked by current thread
+        if (lock.locker_thread_id.load(std::memory_order_relaxed) == std::this_thread::get_id())
+            return std::expected<access_proxy, admission_rejected>(std::in_place, *this);
+
+        if (!lock.try_lock())
+        {
+            if (auto rejected = lock.reserve_waiter())
+                return std::unexpected(*rejected);
+            lock.lock(detail::waiter_reserved);
+        }
+
+        return std::expected<access_proxy, admission_rejected>(std::in_place, *this, std::adopt_lock);
+    }
+
+    // Access to elements [begin, end) of a range-locked contiguous container, see range_synchronized_value.
+    template <bool Exclusive>
+    class range_proxy
+    {
+        using range_type = detail::range_lockable::range;
+        using element_type = std::remove_reference_t<std::ranges::range_reference_t<std::conditional_t<Exclusive, T &, const T &>>>;
+
+        detail::range_lockable &lock;
+        range_type range;
+        std::span<element_type> elements;
+
+    public:
+        range_proxy(const range_proxy &) = delete;
+        range_proxy &operator=(const range_proxy &) = delete;
+        range_proxy(range_proxy &&) = delete;
+        range_proxy &operator=(range_proxy &&) = delete;
+
+        range_proxy(synchronized_value &p, std::size_t begin, std::size_t end)
+            : lock(p.lock), range{begin, end, Exclusive}
+        {
+            lock.lock_range(range);
+
+            // size is stable now, whole-value access is excluded while the range is held
+            if (begin > end || end > std::ranges::size(p.obj))
+            {
+                lock.unlock_range(range);
+                throw std::out_of_range("synchronized_value::lock_range: range exceeds the container");
+            }
+            elements = std::span<element_type>(std::ranges::data(p.obj) + begin, end - begin);
+        }
+
+        ~range_proxy()
+        {
+            lock.unlock_range(range);
+        }
+
+        std::span<element_type> operator*() const { return elements; }
+        element_type &operator[](std::size_t index) const { return elements[index]; }
+        std::size_t size() const { return elements.size(); }
+        auto begin() const { return elements.begin(); }
+        auto end() const { return elements.end(); }
+    };
+
+    // Shared access through one of the K slots of a k-exclusion value, see k_synchronized_value.
+    class slot_proxy
+    {
+        synchronized_value &ptr;
+        std::size_t index;
+
+    public:
+        slot_proxy(const slot_proxy &) = delete;
+        slot_proxy &operator=(const slot_proxy &) = delete;
+        slot_proxy(slot_proxy &&) = delete;
+        slot_proxy &operator=(slot_proxy &&) = delete;
+
+        slot_proxy(synchronized_value &p)
+            : ptr(p), index(p.lock.lock_slot())
+        {}
+
+        ~slot_proxy()
+        {
+            ptr.lock.unlock_slot(index);
+        }
+
+        // the partition of the value this thread may use, in [0, K)
+        std::size_t slot() const { return index; }
+
+        no_escape_ptr operator->() { return no_escape_ptr{&(ptr.obj)}; }
+        T &operator*() { return ptr.obj; }
+    };
+
+    // Admits up to K threads at once, each with its own slot index. operator-> stays fully exclusive.
+    template <typename L = Lockable>
+        requires requires(L &lockable, std::size_t index) { lockable.lock_slot(); lockable.unlock_slot(index); }
+    slot_proxy acquire_slot()
+    {
+        return slot_proxy{*this};
+    }
+
+    // Exclusive access to elements [begin, end); disjoint ranges are locked independently.
+    template <typename L = Lockable>
+        requires std::same_as<L, detail::range_lockable> && std::ranges::contiguous_range<T>
+    range_proxy<true> lock_range(std::size_t begin, std::size_t end)
+    {
+        return range_proxy<true>{*this, begin, end};
+    }
+
+    // Read-only access to elements [begin, end), shared with other readers of overlapping ranges.
+    template <typename L = Lockable>
+        requires std::same_as<L, detail::range_lockable> && std::ranges::contiguous_range<T>
+    range_proxy<false> lock_range_shared(std::size_t begin, std::size_t end)
+    {
+        return range_proxy<false>{*this, begin, end};
+    }
+
+    // Single-flight lookup for map-like values: on a miss the first caller runs fn(key)
+    // outside the lock and concurrent callers for the same key park on its result.
+    // The value is installed once; an exception from fn is rethrown to every waiter.
+    template <typename Fn, typename Map = T>
+        requires detail::MapLike<Map> && std::invocable<Fn &, const typename Map::key_type &>
+    typename Map::mapped_type get_or_compute(const typename Map::key_type &key, Fn &&fn)
+    {
+        using mapped_type = typename Map::mapped_type;
+
+        // already locked by current thread - the lock cannot be dropped, compute in place
+        if (lock.locker_thread_id.load(std::memory_order_relaxed) == std::this_thread::get_id())
+        {
+            if (auto it = obj.find(key); it != obj.end())
+                return it->second;
+            return obj.try_emplace(key, std::invoke(fn, key)).first->second;
+        }
+
+        // only the caller starting a flight pays for the promise's shared state
+        std::optional<std::promise<mapped_type>> promise;
+        std::shared_future<mapped_type> flight;
+        {
+            std::lock_guard guard(lock);
+            if (auto it = obj.find(key); it != obj.end())
+                return it->second;
+
+            if (auto it = flights.find(obj, key); it != flights.entries.end())
+                flight = it->second;
+            else
+                flights.entries.emplace_back(key, promise.emplace().get_future().share());
+        }
+
+        if (!promise)
+        {
+            blocking_scope parked;
+            return flight.get();
+        }
+
+        try
+        {
+            mapped_type value = std::invoke(fn, key);
+            {
+                std::lock_guard guard(lock);
+                // someone may have stored the key directly meanwhile - keep theirs
+                value = obj.try_emplace(key, std::move(value)).first->second;
+                flights.erase(obj, key);
+            }
+            promise->set_value(value);
+            return value;
+        }
+        catch (...)
+        {
+            {
+                std::lock_guard guard(lock);
+                flights.erase(obj, key);
+            }
+            promise->set_exception(std::current_exception());
+            throw;
+        }
+    }
+    
+    private:
+        lockable_type lock;
+        T obj;
+        [[no_unique_address]] std::conditional_t<detail::MapLike<T>, detail::flight_table<T>, detail::no_flight_table> flights;
+        
+        template <SynchronizedValue... SVs>
+        friend class synchronized_scope;
+};
+
+// Vector-like value whose elements can also be locked by index range, see lock_range.
+template <typename T>
+using range_synchronized_value = synchronized_value<T, detail::range_lockable>;
+
+// ---------------------------
 // synchronized_scope
 // ---------------------------
+namespace detail{
+    // Forwards to a value's lock, or does nothing for a value the current thread already holds.
+    template <typename Lockable>
+    struct scope_lock_ref
+    {
+        Lockable *target;
+
+        void lock() { if (target) target->lock(); }
+        bool try_lock() { return !target || target->try_lock(); }
+        void unlock() { if (target) target->unlock(); }
+    };
+}
+
 template <SynchronizedValue... SVs>
 class synchronized_scope
 {
-    detail::lockable dummy_lock;
-    std::scoped_lock<typename SVs::lockable_type& ...> lock;
+    std::tuple<detail::scope_lock_ref<typename SVs::lockable_type> ...> locks;
+    std::scoped_lock<detail::scope_lock_ref<typename SVs::lockable_type> & ...> lock;
+
+    template <std::size_t... Is>
+    synchronized_scope(std::index_sequence<Is...>, SVs &... svs)
+        : locks{ detail::scope_lock_ref<typename SVs::lockable_type>{
+                    svs.lock.locker_thread_id.load(std::memory_order_relaxed) != std::this_thread::get_id() ? &svs.lock : nullptr } ... },
+          lock(std::get<Is>(locks) ...)
+    {}
 
 public:
     synchronized_scope(SVs &... svs)
-        : dummy_lock{},
-          lock( (svs.lock.locker_thread_id.load(std::memory_order_relaxed) != std::this_thread::get_id()
-                    ? svs.lock
-                    : dummy_lock) ... )
+        : synchronized_scope(std::index_sequence_for<SVs...>{}, svs...)
+    {}
+};
+
+// ---------------------------
+// relaxed_priority_queue
+// ---------------------------
+// MultiQueue: heaps_per_thread * threads heaps, each behind its own lock. push goes to a
+// random heap, try_pop takes the better top of two random heaps. Ordering is only
+// approximate - a pop returns one of the best few elements - but push/pop no longer
+// serialize on a single lock.
+namespace detail{
+    // xorshift64*, cheap enough to call on every queue operation
+    inline std::uint64_t thread_random()
+    {
+        thread_local std::uint64_t state = std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1;
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545f4914f6cdd1dull;
+    }
+}
+
+template <typename T, typename Compare = std::less<T>>
+class relaxed_priority_queue
+{
+    struct alignas(detail::cache_line_size) heap_slot
+    {
+        detail::lockable lock;
+        std::atomic<std::size_t> size{0};   // written under lock, read without it as a hint
+        std::vector<T> heap;
+    };
+
+    std::size_t heap_count;
+    std::unique_ptr<heap_slot[]> heaps;
+    [[no_unique_address]] Compare compare;
+
+    heap_slot &random_heap() { return heaps[detail::thread_random() % heap_count]; }
+
+    // caller holds slot.lock and the heap is not empty
+    T pop_top(heap_slot &slot)
+    {
+        std::ranges::pop_heap(slot.heap, compare);
+        T top = std::move(slot.heap.back());
+        slot.heap.pop_back();
+        slot.size.store(slot.heap.size(), std::memory_order_relaxed);
+        return top;
+    }
+
+public:
+    explicit relaxed_priority_queue(std::size_t heaps_per_thread = 2, unsigned threads = std::thread::hardware_concurrency(), Compare comp = Compare{})
+        : heap_count(std::max<std::size_t>(heaps_per_thread * std::max(threads, 1u), 1)),
+          heaps(std::make_unique<heap_slot[]>(heap_count)),
+          compare(std::move(comp))
     {}
+
+    relaxed_priority_queue(const relaxed_priority_queue &) = delete;
+    relaxed_priority_queue &operator=(const relaxed_priority_queue &) = delete;
+
+    template <typename... Args>
+    void emplace(Args &&... args)
+    {
+        // skip heaps that are busy right now, after a few misses just queue up
+        heap_slot *slot = nullptr;
+        for (int attempt = 0; attempt < 4 && !slot; ++attempt)
+            if (auto &candidate = random_heap(); candidate.lock.try_lock())
+                slot = &candidate;
+        if (!slot)
+        {
+            slot = &random_heap();
+            slot->lock.lock();
+        }
+
+        std::lock_guard guard(slot->lock, std::adopt_lock);
+        slot->heap.emplace_back(std::forward<Args>(args)...);
+        std::ranges::push_heap(slot->heap, compare);
+        slot->size.store(slot->heap.size(), std::memory_order_relaxed);
+    }
+
+    void push(const T &value) { emplace(value); }
+    void push(T &&value) { emplace(std::move(value)); }
+
+    // Pops one of the highest priority elements, empty optional when the queue looked empty.
+    std::optional<T> try_pop()
+    {
+        for (std::size_t attempt = 0; attempt < 2 * heap_count; ++attempt)
+        {
+            heap_slot &first = random_heap();
+            heap_slot &second = random_heap();
+
+            const bool first_empty = first.size.load(std::memory_order_relaxed) == 0;
+            const bool second_empty = second.size.load(std::memory_order_relaxed) == 0;
+            if (first_empty && second_empty)
+                continue;
+
+            // only ever try_lock here, so holding two heaps cannot deadlock
+            if (&first == &second || first_empty || second_empty)
+            {
+                heap_slot &slot = first_empty ? second : first;
+                if (!slot.lock.try_lock())
+                    continue;
+                std::lock_guard guard(slot.lock, std::adopt_lock);
+                if (slot.heap.empty())
+                    continue;
+                return pop_top(slot);
+            }
+
+            if (!first.lock.try_lock())
+                continue;
+            std::lock_guard first_guard(first.lock, std::adopt_lock);
+            if (!second.lock.try_lock())
+                continue;
+            std::lock_guard second_guard(second.lock, std::adopt_lock);
+
+            if (first.heap.empty() && second.heap.empty())
+                continue;
+            if (second.heap.empty() || (!first.heap.empty() && !compare(first.heap.front(), second.heap.front())))
+                return pop_top(first);
+            return pop_top(second);
+        }
+
+        // random probing kept missing, make sure a non-empty queue is not reported empty
+        for (std::size_t index = 0; index < heap_count; ++index)
+        {
+            heap_slot &slot = heaps[index];
+            if (slot.size.load(std::memory_order_relaxed) == 0)
+                continue;
+            std::lock_guard guard(slot.lock);
+            if (!slot.heap.empty())
+                return pop_top(slot);
+        }
+        return std::nullopt;
+    }
+
+    // approximate while other threads push/pop
+    std::size_t size() const
+    {
+        std::size_t total = 0;
+        for (std::size_t index = 0; index < heap_count; ++index)
+            total += heaps[index].size.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    bool empty() const { return size() == 0; }
 };
+
+// ---------------------------
+// synchronized_lookup_map
+// ---------------------------
+namespace detail{
+    // Grace periods for lock-free readers. Readers bump a striped counter for the current
+    // phase; synchronize() flips the phase twice and waits until both counters drained,
+    // after which no reader can still see anything unpublished before the call.
+    class reader_registry
+    {
+        struct alignas(cache_line_size) stripe
+        {
+            std::atomic<std::int64_t> readers[2] = {};
+        };
+
+        static constexpr std::size_t stripe_count = 16;
+
+        std::atomic<unsigned> phase{0};
+        stripe stripes[stripe_count];
+
+    public:
+        class read_guard
+        {
+            std::atomic<std::int64_t> &counter;
+
+        public:
+            explicit read_guard(std::atomic<std::int64_t> &c) : counter(c)
+            {
+                counter.fetch_add(1, std::memory_order_seq_cst);
+            }
+
+            ~read_guard()
+            {
+                counter.fetch_sub(1, std::memory_order_release);
+            }
+
+            read_guard(const read_guard &) = delete;
+            read_guard &operator=(const read_guard &) = delete;
+        };
+
+        read_guard enter()
+        {
+            const auto index = thread_affinity() % stripe_count;
+            return read_guard{stripes[index].readers[phase.load(std::memory_order_relaxed) & 1]};
+        }
+
+        void synchronize()
+        {
+            for (int flip = 0; flip < 2; ++flip)
+            {
+                // seq_cst loads pair with the readers' seq_cst increment and base load: either the
+                // reader's count is seen here or the reader sees the newly published base
+                const auto drained = phase.fetch_add(1, std::memory_order_seq_cst) & 1;
+                for (auto &s : stripes)
+                    while (s.readers[drained].load(std::memory_order_seq_cst) != 0)
+                        std::this_thread::yield();
+            }
+        }
+    };
+}
+
+// Read-mostly hash map in LSM style: lookups probe an immutable base without locking and
+// consult the small locked delta only when a filter says the key may have been written
+// since the last merge. Writes go to the delta; merge() folds it into a fresh base which
+// is published atomically. With a merge_interval a background thread merges periodically.
+template <typename Key, typename T, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class synchronized_lookup_map
+{
+    using base_map = std::unordered_map<Key, T, Hash, KeyEqual>;
+
+    struct delta_entry
+    {
+        std::optional<T> value;     // empty for an erased key
+        std::uint64_t version;
+    };
+
+    struct delta_state
+    {
+        std::unordered_map<Key, delta_entry, Hash, KeyEqual> entries;
+        std::uint64_t version = 0;
+    };
+
+    // one bit per hash bucket of keys present in the delta
+    static constexpr std::size_t filter_words = 64;
+
+    std::atomic<const base_map *> base;
+    mutable synchronized_value<delta_state> delta{delta_state{}};
+    mutable detail::reader_registry readers;
+    std::atomic<std::uint64_t> filter[filter_words] = {};
+    [[no_unique_address]] Hash hasher;
+    std::mutex merge_mutex;
+    std::jthread merger;
+
+    static std::pair<std::size_t, std::uint64_t> filter_position(std::size_t hash)
+    {
+        hash *= 0x9e3779b97f4a7c15ull;   // spread hashes that only vary in low bits
+        const auto bit = (hash >> 32) % (filter_words * 64);
+        return {bit / 64, std::uint64_t{1} << (bit % 64)};
+    }
+
+    bool maybe_in_delta(const Key &key) const
+    {
+        const auto [word, mask] = filter_position(hasher(key));
+        return (filter[word].load(std::memory_order_acquire) & mask) != 0;
+    }
+
+    void write(const Key &key, std::optional<T> value)
+    {
+        auto state = *delta;
+        auto &entries = (*state).entries;
+        const auto version = ++(*state).version;
+        entries.insert_or_assign(key, delta_entry{std::move(value), version});
+
+        const auto [word, mask] = filter_position(hasher(key));
+        filter[word].fetch_or(mask, std::memory_order_release);
+    }
+
+public:
+    explicit synchronized_lookup_map(base_map initial = {}, std::chrono::milliseconds merge_interval = std::chrono::milliseconds::zero())
+        : base(new base_map(std::move(initial)))
+    {
+        if (merge_interval > std::chrono::milliseconds::zero())
+            merger = std::jthread([this, merge_interval](std::stop_token stop) {
+                std::mutex sleep_mutex;
+                std::condition_variable_any wakeup;
+                std::unique_lock sleeping(sleep_mutex);
+                while (!wakeup.wait_for(sleeping, stop, merge_interval, [&] { return stop.stop_requested(); }))
+                    merge();
+            });
+    }
+
+    synchronized_lookup_map(const synchronized_lookup_map &) = delete;
+    synchronized_lookup_map &operator=(const synchronized_lookup_map &) = delete;
+
+    ~synchronized_lookup_map()
+    {
+        if (merger.joinable())
+        {
+            merger.request_stop();
+            merger.join();
+        }
+        delete base.load(std::memory_order_relaxed);
+    }
+
+    std::optional<T> find(const Key &key) const
+    {
+        if (maybe_in_delta(key))
+        {
+            auto state = *delta;
+            const auto &entries = (*state).entries;
+            if (auto it = entries.find(key); it != entries.end())
+                return it->second.value;
+        }
+
+        // loaded after the delta probe so keys a concurrent merge moved out of it are in this base
+        auto guard = readers.enter();
+        const auto *current = base.load(std::memory_order_seq_cst);
+        if (auto it = current->find(key); it != current->end())
+            return it->second;
+        return std::nullopt;
+    }
+
+    bool contains(const Key &key) const { return find(key).has_value(); }
+
+    void insert_or_assign(const Key &key, T value) { write(key, std::optional<T>(std::move(value))); }
+    void erase(const Key &key) { write(key, std::nullopt); }
+
+    // number of writes not yet folded into the base
+    std::size_t delta_size() const { return delta->entries.size(); }
+
+    // Builds a new base from the current one and the delta outside of any lock readers take,
+    // publishes it and frees the previous base once no reader can be using it anymore.
+    void merge()
+    {
+        std::lock_guard merging(merge_mutex);
+
+        const delta_state snapshot = *delta;
+        if (snapshot.entries.empty())
+            return;
+
+        // only merge() replaces the base and it runs under merge_mutex
+        auto next = std::make_unique<base_map>(*base.load(std::memory_order_relaxed));
+        for (const auto &[key, entry] : snapshot.entries)
+        {
+            if (entry.value)
+                next->insert_or_assign(key, *entry.value);
+            else
+                next->erase(key);
+        }
+
+        const base_map *previous;
+        {
+            auto state = *delta;
+            previous = base.exchange(next.release(), std::memory_order_seq_cst);
+
+            // keep entries written after the snapshot
+            std::erase_if((*state).entries, [&](const auto &item) { return item.second.version <= snapshot.version; });
+
+            // rebuild word by word so bits of keys still in the delta never drop out
+            std::uint64_t rebuilt[filter_words] = {};
+            for (const auto &[key, entry] : (*state).entries)
+            {
+                const auto [word, mask] = filter_position(hasher(key));
+                rebuilt[word] |= mask;
+            }
+            for (std::size_t word = 0; word < filter_words; ++word)
+                filter[word].store(rebuilt[word], std::memory_order_release);
+        }
+
+        readers.synchronize();
+        delete previous;
+    }
+};
+
+// ---------------------------
+// k-exclusion
+// ---------------------------
+namespace detail{
+    // Lock with K independent slots for values that are internally partitioned. A slot
+    // holder owns one partition; the plain lock()/unlock() pair used by operator-> and
+    // scopes takes every slot and so remains fully exclusive. Slot holders are not
+    // covered by value_group::freeze, and a slot holder must not ask for the whole value.
+    template <std::size_t K>
+        requires (K > 0)
+    struct k_exclusion_lockable : lockable
+    {
+        // Lean lock for one slot: no injection points, group or hold accounting of its own.
+        // An exclusive acquisition takes all K of them after the base lock, which already
+        // rolled the injection points; lock_slot rolls them for slot claims.
+        struct alignas(cache_line_size) slot_lock
+        {
+            std::atomic<bool> locked{false};
+            std::atomic<std::uint32_t> waiters{0};
+
+            bool try_lock()
+            {
+                return !locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire);
+            }
+
+            void lock()
+            {
+                if (try_lock())
+                    return;
+
+                // seq_cst registration pairs with the store and load in unlock
+                waiters.fetch_add(1, std::memory_order_seq_cst);
+                const auto spin_deadline = std::chrono::steady_clock::now() + lockable::max_spin_time;
+                for (unsigned spins = 1;; ++spins)
+                {
+                    bool expected = false;
+                    if (locked.compare_exchange_weak(expected, true, std::memory_order_seq_cst))
+                        break;
+
+                    if (spins % 16 != 0 || std::chrono::steady_clock::now() < spin_deadline)
+                    {
+                        cpu_relax();
+                        continue;
+                    }
+
+                    blocking_scope parked;
+                    locked.wait(true, std::memory_order_seq_cst);
+                }
+                waiters.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            void unlock()
+            {
+                locked.store(false, std::memory_order_seq_cst);
+                if (waiters.load(std::memory_order_seq_cst) != 0)
+                    locked.notify_one();
+            }
+        };
+
+        slot_lock slots[K];
+
+        // exclusive holder present or draining the slots - keeps new slot claims out so
+        // maintenance is not starved by steady slot traffic
+        std::atomic<bool> exclusive_locked{false};
+
+        // read by yield_if_contended
+        std::atomic<std::uint32_t> slot_waiters{0};
+        std::atomic<std::uint64_t> slot_releases{0};
+
+        bool has_waiters() const
+        {
+            return lockable::has_waiters() || slot_waiters.load(std::memory_order_relaxed) != 0;
+        }
+
+        std::uint64_t version() const
+        {
+            return lockable::version() + slot_releases.load(std::memory_order_relaxed);
+        }
+
+        // busy slots are drained before an exclusive locker gets in, they count as queued ahead
+        std::optional<admission_rejected> reserve_waiter()
+        {
+            const auto busy = std::ranges::count_if(slots, [](const slot_lock &s) { return s.locked.load(std::memory_order_relaxed); });
+            return lockable::reserve_waiter(static_cast<std::uint32_t>(busy));
+        }
+
+        // exclusive holders serialize on the base lock, then drain the slots in index order
+        void lock()
+        {
+            lockable::lock();
+            lock_slots();
+        }
+
+        void lock(waiter_reserved_t reserved)
+        {
+            lockable::lock(reserved);
+            lock_slots();
+        }
+
+        void lock_slots()
+        {
+            exclusive_locked.store(true, std::memory_order_release);
+            for (auto &s : slots)
+                s.lock();
+        }
+
+        bool try_lock()
+        {
+            if (!lockable::try_lock())
+                return false;
+
+            for (std::size_t index = 0; index < K; ++index)
+            {
+                if (slots[index].try_lock())
+                    continue;
+
+                while (index-- > 0)
+                    slots[index].unlock();
+                lockable::unlock();
+                return false;
+            }
+            exclusive_locked.store(true, std::memory_order_release);
+            return true;
+        }
+
+        void unlock()
+        {
+            for (auto &s : slots)
+                s.unlock();
+            exclusive_locked.store(false, std::memory_order_release);
+            exclusive_locked.notify_all();
+            lockable::unlock();
+        }
+
+        // Claims a free slot scanning from the thread's home slot, so threads tend to keep
+        // to their own slot; when all are busy it queues on the home slot. Waits first while
+        // an exclusive holder is present or draining.
+        std::size_t lock_slot()
+        {
+            inject_contention(injection_point::before_acquire);
+            const auto index = claim_slot();
+            inject_contention(injection_point::after_acquire);
+            return index;
+        }
+
+        void unlock_slot(std::size_t index)
+        {
+            inject_contention(injection_point::before_release);
+            slot_releases.fetch_add(1, std::memory_order_relaxed);
+            slots[index].unlock();
+        }
+
+    private:
+        std::size_t claim_slot()
+        {
+            if (exclusive_locked.load(std::memory_order_acquire))
+            {
+                blocking_scope parked;
+                slot_waiters.fetch_add(1, std::memory_order_relaxed);
+                while (exclusive_locked.load(std::memory_order_acquire))
+                    exclusive_locked.wait(true, std::memory_order_acquire);
+                slot_waiters.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            const auto home = thread_affinity() % K;
+            for (std::size_t offset = 0; offset < K; ++offset)
+            {
+                const auto index = (home + offset) % K;
+                if (slots[index].try_lock())
+                    return index;
+            }
+
+            slot_waiters.fetch_add(1, std::memory_order_relaxed);
+            slots[home].lock();
+            slot_waiters.fetch_sub(1, std::memory_order_relaxed);
+            return home;
+        }
+    };
+}
+
+// Value usable by up to K threads at once through acquire_slot, or exclusively through operator->.
+template <typename T, std::size_t K>
+using k_synchronized_value = synchronized_value<T, detail::k_exclusion_lockable<K>>;